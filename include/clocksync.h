@@ -0,0 +1,126 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <SDL2/SDL.h>
+#include <enet/enet.h>
+#include <string>
+#include <array>
+#include "shared.h"
+
+//----DEFS----
+#define CLOCK_SAMPLES 8 //Ping samples kept for the minimum-delay filter
+#define CLOCK_PING_RATE 1000 //ms between pings
+
+//----FUNCS----
+long long getMicros(){
+    //Local monotonic clock. Only meaningful relative to other getMicros() values.
+    static Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 counter = SDL_GetPerformanceCounter();
+    return static_cast<long long>((counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency);
+}
+
+//----STRUCTS----
+//NTP-style estimate of a remote clock, fed by ping/pong exchanges:
+//  t0 = ping sent (local), t1 = ping received (remote), t2 = pong sent (remote), t3 = pong received (local)
+//Keeps the last few samples and trusts the one with the smallest round trip, since queueing
+//only ever adds delay. The true offset lies within +/- error() of offset().
+class ClockSync{
+    public:
+        void addSample(long long t0, long long t1, long long t2, long long t3){
+            Sample& s = samples[count % CLOCK_SAMPLES];
+            s.offset = ((t1 - t0) + (t2 - t3)) / 2;
+            s.delay = (t3 - t0) - (t2 - t1);
+            if (s.delay < 0)
+                s.delay = 0;
+            count++;
+
+            best = samples[0];
+            for (int i = 1; i < CLOCK_SAMPLES && i < count; i++){
+                if (samples[i].delay < best.delay)
+                    best = samples[i];
+            }
+        }
+
+        bool synced() const{ return count > 0; }
+        long long offset() const{ return best.offset; } //Remote clock minus local clock
+        long long error() const{ return best.delay / 2; }
+        long long rtt() const{ return best.delay; }
+        long long toLocal(long long remoteTime) const{ return remoteTime - best.offset; }
+
+        //One-way delay of a packet stamped by the remote side, smoothed like RFC 3550 jitter.
+        //localReceived is taken when the packet is processed, not when it reached the socket, so a
+        //receiver that only polls once per frame (the client) reads up to a frame high. The same
+        //bias applies to t3 and hence to the round trip and error bound.
+        void recordInbound(long long remoteSent, long long localReceived){
+            if (!synced())
+                return;
+            long long d = localReceived - toLocal(remoteSent);
+            inbound = hasInbound ? inbound + (d - inbound) / 8 : d;
+            hasInbound = true;
+        }
+
+        //Delays are meaningless until the matching flag is set; -1 stands for "unknown" on the wire
+        bool hasInboundDelay() const{ return hasInbound; }
+        bool hasOutboundDelay() const{ return hasOutbound; }
+        long long inboundDelay() const{ return inbound; } //Remote -> local, measured here
+        long long outboundDelay() const{ return outbound; } //Local -> remote, as reported by the remote side
+
+        void reportOutbound(long long d){
+            hasOutbound = d >= 0;
+            if (hasOutbound)
+                outbound = d;
+        }
+
+    private:
+        struct Sample{
+            long long offset = 0;
+            long long delay = 0;
+        };
+
+        std::array<Sample, CLOCK_SAMPLES> samples;
+        Sample best;
+        int count = 0;
+        long long inbound = 0;
+        long long outbound = 0;
+        bool hasInbound = false;
+        bool hasOutbound = false;
+};
+
+//----PING/PONG----
+//Ping: "<type>t0"    Pong: "<type>t0;t1;t2;inbound"
+//Both sides ping each other, so each has its own offset estimate. The pong also carries the
+//responder's measured inbound delay, which is the pinger's outbound delay.
+void sendPing(ENetPeer* peer, int type){
+    std::string packetData;
+    packetData += std::to_string(type);
+    packetData += std::to_string(getMicros()); //t0
+
+    //Unreliable: a retransmitted ping would report a stale round trip
+    ENetPacket* packet = enet_packet_create(packetData.c_str(), packetData.length() + 1, 0);
+    enet_peer_send(peer, 0, packet);
+}
+
+void answerPing(ENetPeer* peer, int type, std::string& data, long long received, ClockSync& clock){
+    std::string packetData;
+    packetData += std::to_string(type);
+    packetData += data.substr(1); //t0
+    packetData += ";";
+    packetData += std::to_string(received); //t1
+    packetData += ";";
+    packetData += std::to_string(getMicros()); //t2
+    packetData += ";";
+    packetData += std::to_string(clock.hasInboundDelay() ? clock.inboundDelay() : -1);
+
+    ENetPacket* packet = enet_packet_create(packetData.c_str(), packetData.length() + 1, 0);
+    enet_peer_send(peer, 0, packet);
+}
+
+void parsePong(std::string& data, long long received, ClockSync& clock){
+    std::string values[4]; //t0, t1, t2, inbound
+    grabStrings(data, values);
+
+    clock.addSample(stoll(values[0]), stoll(values[1]), stoll(values[2]), received);
+    clock.reportOutbound(stoll(values[3]));
+}
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <array>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <chrono>
+
+//----DEFS----
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO //Anything below this is compiled out. Override with -DLOG_LEVEL=...
+#endif
+
+#define LOG_RING_SIZE 1024 //Records per thread; must be a power of two
+#define LOG_MAX_ARGS 6
+#define LOG_RATE_LIMIT 200 //Records per second allowed from a single call site
+
+//----STRUCTS----
+//Log arguments are stored raw and only formatted on the writer thread.
+//Strings are stored by pointer, so only pass string literals.
+struct LogArg{
+    enum{INT, UINT, FLOAT, STR} type;
+    union{
+        long long i;
+        unsigned long long u;
+        double f;
+        const char* s;
+    };
+};
+
+struct LogRecord{
+    Uint64 time; //Raw performance counter
+    int level;
+    const char* format; //"{}" marks each argument
+    int argCount;
+    LogArg args[LOG_MAX_ARGS];
+};
+
+//Single-producer single-consumer ring. Each logging thread owns one; the writer thread drains them all.
+class LogRing{
+    public:
+        bool push(const LogRecord& record){
+            size_t head = this->head.load(std::memory_order_relaxed);
+            if (head - tail.load(std::memory_order_acquire) == LOG_RING_SIZE)
+                return false; //Full
+            records[head & (LOG_RING_SIZE - 1)] = record;
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(LogRecord& record){
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            if (tail == head.load(std::memory_order_acquire))
+                return false; //Empty
+            record = records[tail & (LOG_RING_SIZE - 1)];
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::array<LogRecord, LOG_RING_SIZE> records;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+};
+
+//Caps how often a single call site may log. Races between threads only make the cap approximate.
+struct LogRateLimit{
+    std::atomic<Uint64> window{0};
+    std::atomic<int> count{0};
+
+    bool allow(Uint64 now){ //now = current second, derived from the record's timestamp
+        if (window.load(std::memory_order_relaxed) != now){
+            window.store(now, std::memory_order_relaxed);
+            count.store(0, std::memory_order_relaxed);
+        }
+        return count.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT;
+    }
+};
+
+class Logger{
+    public:
+        Logger(){
+            frequency = SDL_GetPerformanceFrequency();
+        }
+
+        ~Logger(){
+            stop();
+        }
+
+        void start(){
+            if (running.exchange(true))
+                return;
+            startTime = SDL_GetPerformanceCounter();
+            writer = std::thread(&Logger::run, this);
+        }
+
+        //Drain everything still queued, then stop the writer thread
+        void stop(){
+            if (!running.exchange(false))
+                return;
+            writer.join();
+        }
+
+        template<typename... Args>
+        void write(int level, Uint64 time, const char* format, Args... args){
+            static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+
+            LogRecord record;
+            record.time = time; //Raw performance counter, read once by the call site
+            record.level = level;
+            record.format = format;
+            record.argCount = 0;
+            int unpack[] = {0, (record.args[record.argCount++] = makeArg(args), 0)...};
+            (void)unpack;
+
+            if (!localRing().push(record))
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Uint64 ticksPerSecond() const{ return frequency; }
+        void suppress(){ suppressedCount.fetch_add(1, std::memory_order_relaxed); }
+        unsigned long long dropped() const{ return droppedCount.load(std::memory_order_relaxed); }
+        unsigned long long suppressed() const{ return suppressedCount.load(std::memory_order_relaxed); }
+
+    private:
+        static LogArg makeArg(int v){ LogArg a; a.type = LogArg::INT; a.i = v; return a; }
+        static LogArg makeArg(long v){ LogArg a; a.type = LogArg::INT; a.i = v; return a; }
+        static LogArg makeArg(long long v){ LogArg a; a.type = LogArg::INT; a.i = v; return a; }
+        static LogArg makeArg(unsigned int v){ LogArg a; a.type = LogArg::UINT; a.u = v; return a; }
+        static LogArg makeArg(unsigned long v){ LogArg a; a.type = LogArg::UINT; a.u = v; return a; }
+        static LogArg makeArg(unsigned long long v){ LogArg a; a.type = LogArg::UINT; a.u = v; return a; }
+        static LogArg makeArg(double v){ LogArg a; a.type = LogArg::FLOAT; a.f = v; return a; }
+        static LogArg makeArg(const char* v){ LogArg a; a.type = LogArg::STR; a.s = v; return a; }
+
+        LogRing& localRing(){
+            thread_local LogRing* ring = nullptr;
+            if (ring == nullptr){
+                //First record from this thread: register a ring (the only time logging takes a lock)
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                rings.emplace_back(new LogRing());
+                ring = rings.back().get();
+            }
+            return *ring;
+        }
+
+        void run(){
+            std::string line;
+            std::vector<LogRing*> active; //Writer's own copy of rings
+            unsigned long long reportedDrops = 0, reportedSuppressed = 0;
+            bool keepGoing = true;
+
+            while (keepGoing){
+                keepGoing = running.load(); //Read before draining so the final pass catches everything
+                bool wrote = false;
+
+                //Only copy the ring list under the lock, so a thread registering its ring never waits on I/O.
+                //Rings are never removed, so the pointers stay valid.
+                {
+                    std::lock_guard<std::mutex> lock(ringsMutex);
+                    for (size_t i = active.size(); i < rings.size(); i++)
+                        active.push_back(rings[i].get());
+                }
+
+                LogRecord record;
+                for (LogRing* ring : active){
+                    while (ring->pop(record)){
+                        format(record, line);
+                        fwrite(line.data(), 1, line.size(), stdout);
+                        wrote = true;
+                    }
+                }
+
+                if (dropped() != reportedDrops || suppressed() != reportedSuppressed){
+                    reportedDrops = dropped();
+                    reportedSuppressed = suppressed();
+                    fprintf(stdout, "[LOGGER] %llu records dropped, %llu rate limited so far\n", reportedDrops, reportedSuppressed);
+                    wrote = true;
+                }
+
+                if (wrote)
+                    fflush(stdout);
+                else if (keepGoing)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void format(const LogRecord& record, std::string& line){
+            static const char* levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+            char buffer[64];
+
+            Uint64 elapsed = record.time - startTime;
+            snprintf(buffer, sizeof(buffer), "[%.6f] [%s] ", static_cast<double>(elapsed) / frequency, levels[record.level]);
+            line = buffer;
+
+            int arg = 0;
+            for (const char* c = record.format; *c != '\0'; c++){
+                if (c[0] != '{' || c[1] != '}' || arg >= record.argCount){
+                    line += *c;
+                    continue;
+                }
+
+                const LogArg& a = record.args[arg++];
+                switch (a.type){
+                    case LogArg::INT:
+                        snprintf(buffer, sizeof(buffer), "%lld", a.i);
+                        break;
+                    case LogArg::UINT:
+                        snprintf(buffer, sizeof(buffer), "%llu", a.u);
+                        break;
+                    case LogArg::FLOAT:
+                        snprintf(buffer, sizeof(buffer), "%g", a.f);
+                        break;
+                    case LogArg::STR:
+                        line += a.s;
+                        buffer[0] = '\0';
+                        break;
+                }
+                line += buffer;
+                c++; //Skip '}'
+            }
+            line += '\n';
+        }
+
+        std::vector<std::unique_ptr<LogRing>> rings;
+        std::mutex ringsMutex;
+        std::thread writer;
+        std::atomic<bool> running{false};
+        std::atomic<unsigned long long> droppedCount{0};
+        std::atomic<unsigned long long> suppressedCount{0};
+        Uint64 frequency = 1;
+        Uint64 startTime = 0;
+};
+
+Logger logger;
+
+//----MACROS----
+//Each call site gets its own rate limiter. Levels below LOG_LEVEL expand to nothing, arguments included.
+//The clock is read once and serves both the rate limit and the record's timestamp.
+#define LOG_WRITE(level, ...) \
+    do{ \
+        static LogRateLimit logLimit_; \
+        Uint64 logTime_ = SDL_GetPerformanceCounter(); \
+        if (logLimit_.allow(logTime_ / logger.ticksPerSecond())) \
+            logger.write(level, logTime_, __VA_ARGS__); \
+        else \
+            logger.suppress(); \
+    }while(0)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_WRITE(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do{}while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_WRITE(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do{}while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_WRITE(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do{}while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_WRITE(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do{}while(0)
+#endif
+
+#endif
@@ -12,9 +12,16 @@
 #define MAX_PLAYERS 4
 #define THRESHOLD 60 //Number of samples taken for analysis
 #define CRITICAL_ZONE_RADIUS 100
-
-enum class serverPacket{INITIALIZE, UPDATE, DISCONNECT};
-enum class clientPacket{UPDATE};
+#define SAMPLE_RATE 1000 //ms per detector sample
+#define PLAYER_TIMEOUT 5000 //ms without packets before a player is disconnected
+#define SERVER_PORT 4450
+#define RELAY_PORT 4451
+#define MAX_RELAYS 2 //Spectator connections the game server accepts; observers go through a relay
+#define MAX_OBSERVERS 256 //Per relay. Relays can subscribe to other relays for more.
+
+enum class serverPacket{INITIALIZE, UPDATE, DISCONNECT, PING, PONG, SCORES};
+enum class clientPacket{UPDATE, PING, PONG};
+enum class connectType{PLAYER, SPECTATOR}; //Sent as the ENet connect data
 
 //----SHARED STRUCTS----
 
@@ -0,0 +1,102 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <array>
+
+//----DEFS----
+#define WHEEL_SLOTS 256 //Must be a power of two
+#define WHEEL_TICK 16 //ms per slot
+
+//----STRUCTS----
+//Intrusive timer entry. Embed one in whatever owns the deadline (e.g. a Player)
+//so that arming, re-arming and cancelling never allocate.
+struct TimerNode{
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    unsigned int rounds = 0; //Full wheel revolutions left before expiry
+    int owner = -1; //Id of whatever the timer belongs to (player id)
+    int kind = 0; //What to do when it fires
+
+    bool armed() const{ return next != nullptr; }
+};
+
+//Hashed timing wheel (Varghese & Lauck). Every operation is O(1) regardless of how
+//many timers are armed; advancing only touches the slots that have come due.
+class TimerWheel{
+    public:
+        TimerWheel(){
+            for (auto& s : slots)
+                s.prev = s.next = &s;
+        }
+
+        void start(unsigned int now){
+            lastTime = now;
+        }
+
+        //(Re)arm a timer to fire after delay ms. Safe to call on an already armed timer.
+        void schedule(TimerNode* node, unsigned int delay){
+            cancel(node);
+
+            unsigned int ticks = (delay + WHEEL_TICK - 1) / WHEEL_TICK;
+            if (ticks == 0)
+                ticks = 1;
+
+            node->rounds = (ticks - 1) / WHEEL_SLOTS;
+            link(&slots[(current + ticks) & (WHEEL_SLOTS - 1)], node);
+        }
+
+        void cancel(TimerNode* node){
+            if (!node->armed())
+                return;
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            node->prev = node->next = nullptr;
+        }
+
+        //Run every slot that has come due since the last call. fire(TimerNode*) may
+        //schedule or cancel any timer, including the one being fired.
+        template<typename F>
+        void advance(unsigned int now, F fire){
+            while (now - lastTime >= WHEEL_TICK){
+                lastTime += WHEEL_TICK;
+                current = (current + 1) & (WHEEL_SLOTS - 1);
+
+                //Move expired timers out of the slot first so callbacks can't disturb the walk
+                TimerNode expired;
+                expired.prev = expired.next = &expired;
+
+                TimerNode* head = &slots[current];
+                for (TimerNode* n = head->next; n != head;){
+                    TimerNode* next = n->next;
+                    if (n->rounds > 0){
+                        n->rounds--;
+                    }
+                    else{
+                        cancel(n);
+                        link(&expired, n);
+                    }
+                    n = next;
+                }
+
+                while (expired.next != &expired){
+                    TimerNode* n = expired.next;
+                    cancel(n);
+                    fire(n);
+                }
+            }
+        }
+
+    private:
+        void link(TimerNode* head, TimerNode* node){
+            node->prev = head->prev;
+            node->next = head;
+            head->prev->next = node;
+            head->prev = node;
+        }
+
+        std::array<TimerNode, WHEEL_SLOTS> slots; //Sentinel heads of each slot's list
+        unsigned int current = 0;
+        unsigned int lastTime = 0;
+};
+
+#endif
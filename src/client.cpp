@@ -3,10 +3,13 @@
 #include <iostream>
 #include <enet/enet.h>
 #include "shared.h"
+#include "clocksync.h"
+#include "logger.h"
 #include <vector>
 #include <array>
 #include <cmath>
 #include <map>
+#include <sstream>
 
 //----STRUCTS----
 typedef struct{
@@ -35,7 +38,9 @@ void doGameLogic();
 void doDrawing();
 void processPacket(ENetPacket*);
 void parseInitPacket(std::string&);
-void parseUpdatePacket(std::string&);
+void parseUpdatePacket(std::string&, long long);
+void parseScoresPacket(std::string&);
+void runSpectator();
 void updateServer();
 int getPacketData(ENetPacket*, std::string&);
 void DrawCircle(SDL_Renderer*, int32_t, int32_t, int32_t); //NOT MY CODE; THIS IS A WINDOWS "IMPORT"
@@ -43,18 +48,34 @@ void DrawCircle(SDL_Renderer*, int32_t, int32_t, int32_t); //NOT MY CODE; THIS I
 unsigned int sendSample(unsigned int, void*);
 
 //----Global Vars----
+ENetHost* client; //Local ENet host, flushed right after timestamped sends
 ENetPeer* peer; //The server-client connection
 ENetEvent event; //Holds events from queue
 bool initialized = false;
 bool dropPackets = false;
 bool drawCircle = false;
 bool badConnection = false;
+bool spectating = false; //Headless, read-only observer (client --spectate [ip] [port])
 Player* self = nullptr;
+ClockSync serverClock; //Server clock relative to ours, and one-way delays both ways
 
 int critical_counter; //Accumulator for critical events
 
 //
 int main(int argc, char* argv[]){
+    const char* host = "127.0.0.1";
+    int port = SERVER_PORT;
+
+    if (argc > 1 && std::string(argv[1]) == "--spectate"){
+        //Observers normally attach to a relay rather than the game server
+        spectating = true;
+        port = RELAY_PORT;
+        if (argc > 2)
+            host = argv[2];
+        if (argc > 3)
+            port = atoi(argv[3]);
+    }
+
     //Initialize
 
     if (enet_initialize() != 0){
@@ -63,9 +84,9 @@ int main(int argc, char* argv[]){
     }
 
     atexit(cleanup); //Call this automatically when program closes
+    logger.start();
 
     //CONNECT TO SERVER
-    ENetHost* client;
     ENetAddress address; //Holds server IP and port
     
     client = enet_host_create(NULL, 1, 1, 0, 0);
@@ -74,10 +95,11 @@ int main(int argc, char* argv[]){
         exit(1);
     }
 
-    enet_address_set_host(&address, "127.0.0.1");
-    address.port = 4450;
+    enet_address_set_host(&address, host);
+    address.port = port;
 
-    peer = enet_host_connect(client, &address, 1, 0);
+    connectType type = spectating ? connectType::SPECTATOR : connectType::PLAYER;
+    peer = enet_host_connect(client, &address, 1, static_cast<int>(type));
     std::cout << "Connecting to server..." << std::endl;
     if (peer == NULL){
         std::cout << "Failed to connect with the server." << std::endl;
@@ -94,6 +116,9 @@ int main(int argc, char* argv[]){
         exit(0);
     }
 
+    if (spectating)
+        runSpectator(); //Never returns
+
     //Initialization loop
     std::cout << "Awaiting player initialization from server..." << std::endl;
     while (!initialized){
@@ -106,6 +131,13 @@ int main(int argc, char* argv[]){
                     continue;
                 parseInitPacket(data);
             }
+            else if (event.type == ENET_EVENT_TYPE_DISCONNECT){
+                //The server turns players away here when it is full
+                peer = NULL;
+                std::cout << "Connection refused; the server may be full." << std::endl;
+                system("pause");
+                exit(0);
+            }
         }
     }
 
@@ -113,6 +145,7 @@ int main(int argc, char* argv[]){
     init_SDL(); 
 
     SDL_TimerID sampleTimer = SDL_AddTimer(1000, sendSample, NULL); //Send critical moment sample
+    unsigned int lastPing = 0;
 
     //GAME LOOP
     while(true){
@@ -123,7 +156,7 @@ int main(int argc, char* argv[]){
                     processPacket(event.packet);
                     break;
                 case ENET_EVENT_TYPE_DISCONNECT:
-                    std::cout << "Server at " << event.peer->address.host << ":" << event.peer->address.port << " closed." << std::endl;
+                    LOG_WARN("Server at {}:{} closed.", event.peer->address.host, event.peer->address.port);
                     break;
             }
         }
@@ -137,6 +170,19 @@ int main(int argc, char* argv[]){
                 chance = random_range(0,3);
             if (chance == 0)
                 updateServer();
+
+            if (SDL_GetTicks() - lastPing >= CLOCK_PING_RATE){
+                if (serverClock.synced() && serverClock.hasInboundDelay() && serverClock.hasOutboundDelay()){
+                    LOG_INFO("Server clock offset {}ms (+/-{}ms) | Down {}ms, Up {}ms", serverClock.offset() / 1000.0, serverClock.error() / 1000.0,
+                             serverClock.inboundDelay() / 1000.0, serverClock.outboundDelay() / 1000.0);
+                }
+                else if (serverClock.synced()){
+                    LOG_INFO("Server clock offset {}ms (+/-{}ms) | Delays pending", serverClock.offset() / 1000.0, serverClock.error() / 1000.0);
+                }
+                sendPing(peer, static_cast<int>(clientPacket::PING));
+                enet_host_flush(client); //Don't let t0 sit out the rest of the frame
+                lastPing = SDL_GetTicks();
+            }
         }
             
         doDrawing(); //Drawing
@@ -217,13 +263,13 @@ void doGameLogic(){
     //Toggle dropPackets
     if (app.input[SDL_SCANCODE_SPACE]){
         if (!dropPackets){
-            std::cout << "[PACKET SWITCHING ON]" << std::endl;
+            LOG_INFO("[PACKET SWITCHING ON]");
             dropPackets = true;
         }
     }
     else{
         if (dropPackets){
-            std::cout << "[PACKET SWITCHING OFF]" << std::endl;
+            LOG_INFO("[PACKET SWITCHING OFF]");
             dropPackets = false;
         }
     }
@@ -302,9 +348,11 @@ void cleanup(){
     SDL_DestroyRenderer(app.renderer);
     SDL_DestroyWindow(app.window);
     SDL_Quit();
+    logger.stop();
 }
 
 void processPacket(ENetPacket* packet){
+    long long received = getMicros();
     std::string data;
     int type = getPacketData(packet, data);
 
@@ -316,7 +364,23 @@ void processPacket(ENetPacket* packet){
         case 1:
             //UPDATE
             if (!dropPackets)
-                parseUpdatePacket(data);
+                parseUpdatePacket(data, received);
+            break;
+        case 3:
+            //PING
+            if (!dropPackets){
+                answerPing(peer, static_cast<int>(clientPacket::PONG), data, received, serverClock);
+                enet_host_flush(client);
+            }
+            break;
+        case 4:
+            //PONG
+            if (!dropPackets)
+                parsePong(data, received, serverClock);
+            break;
+        case 5:
+            //SCORES
+            parseScoresPacket(data);
             break;
     }
 }
@@ -352,16 +416,25 @@ void updateServer(){
     packetData += std::to_string(self->x); //x
     packetData += ';';
     packetData += std::to_string(self->y); //y
+    packetData += ';';
+    packetData += std::to_string(getMicros()); //Send time, for one-way delay on the server
 
     ENetPacket* packet = enet_packet_create(packetData.c_str(), packetData.length() + 1, 0);
     enet_peer_send(peer, 0, packet);
+    enet_host_flush(client); //Send now; otherwise the timestamp waits out drawing and SDL_Delay
 }
 
-void parseUpdatePacket(std::string& data){
+void parseUpdatePacket(std::string& data, long long received){
+    //Server send time comes first, then id;x;y for each player
+    size_t start = data.find(';');
+    if (start == std::string::npos)
+        start = data.length();
+    serverClock.recordInbound(stoll(data.substr(1, start - 1)), received);
+
     //Parse string
     std::map<int,std::array<std::string, 3>> playerData;
 
-    for (int i=1; i < data.length(); i++){
+    for (int i=start + 1; i < data.length(); i++){
         std::array<std::string, 3> pData;
 
         for (int j=0; j < 3 && i < data.length(); i++){
@@ -385,7 +458,7 @@ void parseUpdatePacket(std::string& data){
         if (iter == playerList.end()){
             Player newPlayer = {id, stoi(p.second[1]), stoi(p.second[2])};
             playerList[id] = newPlayer;
-            std::cout << "Added player entry: [" << id << "]." << std::endl;
+            LOG_INFO("Added player entry: [{}].", id);
         }
     }
 
@@ -394,12 +467,12 @@ void parseUpdatePacket(std::string& data){
         auto iter = playerData.find(p.second.id);
         if (iter == playerData.end()){
             playerList.erase(p.second.id);
-            std::cout << "Player [" << p.second.id << "] disconnected." << std::endl;
+            LOG_INFO("Player [{}] disconnected.", p.second.id);
         }
     }
 
     for (auto& p : playerList){
-        if (p.second.id == self->id)
+        if (self != nullptr && p.second.id == self->id)
             continue;
 
         //Update values
@@ -408,8 +481,60 @@ void parseUpdatePacket(std::string& data){
     }
 }
 
+void parseScoresPacket(std::string& data){
+    //id;packets;up;down;error for each player, delays in us, -1 = unknown
+    std::istringstream stream(data.substr(1));
+    std::string value;
+    long long scores[5];
+    int i = 0;
+
+    while (std::getline(stream, value, ';')){
+        scores[i++] = stoll(value);
+        if (i < 5)
+            continue;
+
+        if (scores[2] >= 0 && scores[3] >= 0){
+            LOG_INFO("Player [{}]: {} packets | Up {}ms, Down {}ms (+/-{}ms)", scores[0], scores[1],
+                     scores[2] / 1000.0, scores[3] / 1000.0, scores[4] / 1000.0);
+        }
+        else if (scores[2] >= 0){
+            LOG_INFO("Player [{}]: {} packets | Up {}ms, Down unknown (+/-{}ms)", scores[0], scores[1],
+                     scores[2] / 1000.0, scores[4] / 1000.0);
+        }
+        else if (scores[3] >= 0){
+            LOG_INFO("Player [{}]: {} packets | Up unknown, Down {}ms (+/-{}ms)", scores[0], scores[1],
+                     scores[3] / 1000.0, scores[4] / 1000.0);
+        }
+        else{
+            LOG_INFO("Player [{}]: {} packets | Delays unknown", scores[0], scores[1]);
+        }
+        i = 0;
+    }
+}
+
+void runSpectator(){
+    //No window or input; just follow the snapshot stream and print detector scores
+    LOG_INFO("Spectating. Detector scores are printed every second.");
+
+    while(true){
+        while(enet_host_service(client, &event, 1000) > 0){
+            switch(event.type){
+                case ENET_EVENT_TYPE_RECEIVE:
+                    processPacket(event.packet);
+                    enet_packet_destroy(event.packet);
+                    break;
+                case ENET_EVENT_TYPE_DISCONNECT:
+                    LOG_WARN("Server at {}:{} closed.", event.peer->address.host, event.peer->address.port);
+                    peer = NULL;
+                    exit(0);
+                    break;
+            }
+        }
+    }
+}
+
 unsigned int sendSample(unsigned int a, void* b){
-    std::cout << "Counter: " << critical_counter << std::endl;
+    LOG_INFO("Counter: {}", critical_counter);
     critical_counter = 0;
     return 1000;
 }
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <enet/enet.h>
+#include <string>
+#include <cstdlib>
+#include "shared.h"
+#include "logger.h"
+#include <SDL2/SDL.h>
+
+//Subscribes to a game server as a single spectator and re-broadcasts its snapshot stream
+//to any number of observers, so the game server's outgoing bandwidth doesn't grow with them.
+//Usage: relay [server ip] [server port] [listen port]
+
+//---FUNCS---
+void cleanup();
+void forwardPacket(ENetPacket*);
+
+ENetHost* upstream; //Connection to the game server (or another relay)
+ENetHost* relay; //Observers connect here
+ENetPeer* serverPeer;
+ENetEvent event;
+
+int main(int argc, char* argv[]){
+    const char* serverHost = argc > 1 ? argv[1] : "127.0.0.1";
+    int serverPort = argc > 2 ? atoi(argv[2]) : SERVER_PORT;
+    int listenPort = argc > 3 ? atoi(argv[3]) : RELAY_PORT;
+
+    //Initialize
+    if (enet_initialize() != 0){
+        std::cout << "Failed to initialize ENet." << std::endl;
+        exit(1);
+    }
+
+    atexit(cleanup);
+    logger.start();
+
+    //Create relay
+    ENetAddress address;
+    address.host = ENET_HOST_ANY;
+    address.port = listenPort;
+
+    relay = enet_host_create(&address, MAX_OBSERVERS, 1, 0, 0);
+    upstream = enet_host_create(NULL, 1, 1, 0, 0);
+
+    if (relay == NULL || upstream == NULL){
+        std::cout << "Failed to create an ENet relay." << std::endl;
+        exit(1);
+    }
+
+    //Subscribe to the server
+    enet_address_set_host(&address, serverHost);
+    address.port = serverPort;
+
+    serverPeer = enet_host_connect(upstream, &address, 1, static_cast<int>(connectType::SPECTATOR));
+    std::cout << "Subscribing to " << serverHost << ":" << serverPort << "..." << std::endl;
+
+    if (serverPeer == NULL || enet_host_service(upstream, &event, 5000) <= 0
+        || event.type != ENET_EVENT_TYPE_CONNECT){
+        std::cout << "Connection failed." << std::endl;
+        exit(1);
+    }
+
+    std::cout << "Relay created at port " << relay->address.port << ". Ready for observers." << std::endl;
+
+    while(true){
+        //Snapshots from the server
+        while(enet_host_service(upstream, &event, 0) > 0){
+            switch(event.type){
+                case ENET_EVENT_TYPE_RECEIVE:
+                    forwardPacket(event.packet);
+                    break;
+                case ENET_EVENT_TYPE_DISCONNECT:
+                    //Also happens when the server has no relay slots left
+                    LOG_WARN("Server at {}:{} closed.", event.peer->address.host, event.peer->address.port);
+                    serverPeer = NULL;
+                    exit(0);
+                    break;
+            }
+        }
+
+        //Observers only ever listen
+        while(enet_host_service(relay, &event, 1) > 0){
+            switch(event.type){
+                case ENET_EVENT_TYPE_CONNECT:
+                    if (event.data != static_cast<int>(connectType::SPECTATOR)){
+                        LOG_WARN("Rejected {}:{}, not a spectator.", event.peer->address.host, event.peer->address.port);
+                        enet_peer_disconnect(event.peer, 0);
+                        break;
+                    }
+                    LOG_INFO("Observer at {}:{} subscribed. [{}] connected.", event.peer->address.host, event.peer->address.port, relay->connectedPeers);
+                    break;
+                case ENET_EVENT_TYPE_DISCONNECT:
+                    LOG_INFO("Observer at {}:{} disconnected.", event.peer->address.host, event.peer->address.port);
+                    break;
+                case ENET_EVENT_TYPE_RECEIVE:
+                    enet_packet_destroy(event.packet);
+                    break;
+            }
+        }
+    }
+}
+
+void cleanup(){
+    if (serverPeer != NULL)
+        enet_peer_disconnect_now(serverPeer, 0);
+    if (upstream != NULL)
+        enet_host_destroy(upstream);
+
+    if (relay != NULL){
+        for (int i=0; i < relay->peerCount; i++){
+            enet_peer_disconnect_now(&relay->peers[i], 0);
+        }
+        enet_host_destroy(relay);
+    }
+
+    enet_deinitialize();
+    logger.stop();
+}
+
+void forwardPacket(ENetPacket* packet){
+    int type = packet->data[0] - '0'; //Get packet category
+
+    //Only the snapshot stream is relayed. The same packet is queued to every observer, so it's encoded once.
+    if (type != static_cast<int>(serverPacket::UPDATE) && type != static_cast<int>(serverPacket::SCORES)){
+        enet_packet_destroy(packet);
+        return;
+    }
+
+    enet_host_broadcast(relay, 0, packet); //Takes ownership; freed once every observer has sent it
+}
@@ -3,9 +3,13 @@
 #include <string>
 #include <cstdlib>
 #include "shared.h"
+#include "timerwheel.h"
+#include "clocksync.h"
+#include "logger.h"
 #include <vector>
 #include <SDL2/SDL.h>
 #include <map>
+#include <set>
 
 //---STRUCTS---
 typedef struct{
@@ -14,17 +18,29 @@ typedef struct{
     int y;
     SDL_Color color;
     ENetAddress address;
+    ENetPeer* peer;
+    TimerNode timeoutTimer; //Re-armed on every packet received from this player
+    TimerNode sampleTimer; //Closes this player's detector sample window
+    TimerNode pingTimer;
+    ClockSync clock; //This player's clock relative to ours, and one-way delays both ways
+    int lastSample; //Packets received in the last closed sample window
 } Player;
 
+enum class timerEvent{TIMEOUT, SAMPLE, PING, SCORES};
+
 //---FUNCS---
 void cleanup();
 void printPlayerCount();
 void initializePlayer();
-void disconnectPlayer();
+void addSpectator();
+void disconnectPlayer(ENetPeer*);
 void processPacket(ENetPacket*);
-void parseUpdatePacket(std::string&);
+void parseUpdatePacket(Player&, std::string&, long long);
 unsigned int sendUpdatePackets(unsigned int, void*);
-unsigned int analyzePackets(unsigned int, void*);
+void analyzePackets(Player&);
+void sendScores();
+void onTimer(TimerNode*);
+Player* findPlayer(int);
 
 //Packet switching detection
 std::map<int, int> packet_counter; //Accumulator for each player
@@ -35,6 +51,9 @@ std::map<int,std::vector<int>> packetCount; //Vector of samples for each player
 ENetHost* server;
 ENetEvent event;
 std::map<int, Player> playerList;
+std::set<ENetPeer*> spectators; //Read-only connections (relays), sent UPDATE and SCORES only
+TimerWheel timers; //Per-player deadlines, advanced from the main loop
+TimerNode scoresTimer;
 
 int main(int argc, char* argv[]){
     if (SDL_Init(SDL_INIT_TIMER) < 0){
@@ -49,13 +68,14 @@ int main(int argc, char* argv[]){
     }
 
     atexit(cleanup);
+    logger.start();
 
     //Create server
     ENetAddress address;
     address.host = ENET_HOST_ANY;
-    address.port = 4450;
+    address.port = SERVER_PORT;
 
-    server = enet_host_create(&address, MAX_PLAYERS, 1, 0, 0);
+    server = enet_host_create(&address, MAX_PLAYERS + MAX_RELAYS, 1, 0, 0);
 
     if (server == NULL){
         std::cout << "Failed to create an ENet server." << std::endl;
@@ -68,18 +88,26 @@ int main(int argc, char* argv[]){
     //Game loop start
     std::srand(time(nullptr)); //Seed the RNG
     SDL_TimerID updateTimer = SDL_AddTimer(16, sendUpdatePackets, NULL); //Call update automatically
-    SDL_TimerID analysisTimer = SDL_AddTimer(1000, analyzePackets, NULL); //Sample rate (also analysis)
+    timers.start(SDL_GetTicks());
+    scoresTimer.kind = static_cast<int>(timerEvent::SCORES);
+    timers.schedule(&scoresTimer, SAMPLE_RATE);
 
     while(true){
         //Receive packet(s)
         while(enet_host_service(server, &event, 0) > 0){
             switch(event.type){
                 case ENET_EVENT_TYPE_CONNECT:
-                    initializePlayer();
+                    if (event.data == static_cast<int>(connectType::SPECTATOR))
+                        addSpectator();
+                    else
+                        initializePlayer();
                     printPlayerCount();
                     break;
                 case ENET_EVENT_TYPE_DISCONNECT:
-                    disconnectPlayer();
+                    if (spectators.erase(event.peer) > 0)
+                        LOG_INFO("Spectator at {}:{} disconnected.", event.peer->address.host, event.peer->address.port);
+                    else
+                        disconnectPlayer(event.peer);
                     printPlayerCount();
                     break;
                 case ENET_EVENT_TYPE_RECEIVE:
@@ -87,6 +115,9 @@ int main(int argc, char* argv[]){
                     break;
             }
         }
+
+        //Fire any per-player deadlines that have come due
+        timers.advance(SDL_GetTicks(), onTimer);
     }
 }
 
@@ -100,16 +131,24 @@ void cleanup(){
     }
         
     enet_deinitialize();
+    logger.stop();
 }
 
 void printPlayerCount(){
-    std::cout << "There are [" << server->connectedPeers << "] players connected." << std::endl;
+    LOG_INFO("There are [{}] players and [{}] spectators connected.", playerList.size(), spectators.size());
 }
 
 void initializePlayer(){
     static int id; //Unique id assigned to players
     int x, y, r, g, b;
 
+    //Spectator slots are shared with players at the ENet level, so enforce the player limit here
+    if (playerList.size() >= MAX_PLAYERS){
+        LOG_WARN("Rejected {}:{}, server is full.", event.peer->address.host, event.peer->address.port);
+        enet_peer_disconnect_now(event.peer, 0); //Frees the peer at once so it gets no UPDATEs
+        return;
+    }
+
     //Construct packet, semicolon separated
     std::string packetData;
     packetData += std::to_string(static_cast<int>(serverPacket::INITIALIZE));
@@ -132,53 +171,91 @@ void initializePlayer(){
     //Add to player list
     SDL_Color newColor = {r,g,b};
     ENetAddress newAddress = event.peer->address;
-    Player newPlayer = {id, x, y, newColor, newAddress};
+    Player newPlayer = {id, x, y, newColor, newAddress, event.peer};
 
     playerList[id] = newPlayer;
-    std::cout << "Initialized " << event.peer->address.host << ":" << event.peer->address.port << " as Player [" << id << "]" << std::endl;
+    Player& player = playerList[id]; //Timers must be armed in place; map entries don't move
+
+    player.timeoutTimer.owner = player.sampleTimer.owner = player.pingTimer.owner = id;
+    player.timeoutTimer.kind = static_cast<int>(timerEvent::TIMEOUT);
+    player.sampleTimer.kind = static_cast<int>(timerEvent::SAMPLE);
+    player.pingTimer.kind = static_cast<int>(timerEvent::PING);
+    timers.schedule(&player.timeoutTimer, PLAYER_TIMEOUT);
+    timers.schedule(&player.sampleTimer, SAMPLE_RATE);
+    timers.schedule(&player.pingTimer, 0);
+    event.peer->data = &player;
+
+    LOG_INFO("Initialized {}:{} as Player [{}]", event.peer->address.host, event.peer->address.port, id);
 
     ++id;
 }
 
-void disconnectPlayer(){
-    //Find and remove
-    for (auto& p : playerList){
-        if (p.second.address.host != event.peer->address.host ||
-            p.second.address.port != event.peer->address.port)
-            continue;
-        playerList.erase(p.second.id);
-        std::cout << "Player [" << p.second.id << "] at " << event.peer->address.host << ":" << event.peer->address.port << " disconnected." << std::endl;
+void addSpectator(){
+    if (spectators.size() >= MAX_RELAYS){
+        LOG_WARN("Rejected spectator {}:{}, no relay slots left.", event.peer->address.host, event.peer->address.port);
+        enet_peer_disconnect_now(event.peer, 0);
+        return;
     }
+
+    spectators.insert(event.peer);
+    LOG_INFO("Spectator at {}:{} subscribed.", event.peer->address.host, event.peer->address.port);
+}
+
+void disconnectPlayer(ENetPeer* peer){
+    Player* player = static_cast<Player*>(peer->data);
+    if (player == nullptr)
+        return;
+
+    int id = player->id;
+    timers.cancel(&player->timeoutTimer);
+    timers.cancel(&player->sampleTimer);
+    timers.cancel(&player->pingTimer);
+    LOG_INFO("Player [{}] at {}:{} disconnected.", id, peer->address.host, peer->address.port);
+
+    peer->data = nullptr;
+    playerList.erase(id);
+    packet_counter.erase(id);
+    packetCount.erase(id);
 }
 
 void processPacket(ENetPacket* packet){
+    long long received = getMicros();
+
+    //Any traffic counts as a sign of life
+    Player* player = static_cast<Player*>(event.peer->data);
+    if (player == nullptr)
+        return;
+    timers.schedule(&player->timeoutTimer, PLAYER_TIMEOUT);
+
     std::string data(reinterpret_cast<char const*>(packet->data));
 
     int type = data[0] - '0'; //Get packet category
     switch (type){
         case 0:
             //UPDATE
-            parseUpdatePacket(data);
+            parseUpdatePacket(*player, data, received);
+            break;
+        case 1:
+            //PING
+            answerPing(event.peer, static_cast<int>(serverPacket::PONG), data, received, player->clock);
+            break;
+        case 2:
+            //PONG
+            parsePong(data, received, player->clock);
+            break;
     }
 }
 
-void parseUpdatePacket(std::string& data){
-    std::string values[3]; //id, x, y
+void parseUpdatePacket(Player& player, std::string& data, long long received){
+    std::string values[4]; //id, x, y, timestamp
     grabStrings(data, values);
-    
-    //Update player position
-    int id = stoi(values[0]);
 
-    for (auto& p : playerList){
-        if (p.second.id != id) //Find vector element corresponding to player id (I should change vector to map instead)
-            continue;
-        
-        p.second.x = stoi(values[1]);
-        p.second.y = stoi(values[2]);
+    //Credit the peer that sent the packet, not the id it claims; the timestamp is in the sender's clock
+    player.x = stoi(values[1]);
+    player.y = stoi(values[2]);
+    player.clock.recordInbound(stoll(values[3]), received);
 
-        packet_counter[p.second.id]++; //Increment packet count
-        //std::cout << "Player " << id << ": [" << p.x << "," << p.y << "]" << std::endl;
-    }
+    packet_counter[player.id]++; //Increment packet count
 }
 
 unsigned int sendUpdatePackets(unsigned int a, void* b){
@@ -188,47 +265,122 @@ unsigned int sendUpdatePackets(unsigned int a, void* b){
     std::string packetData;
 
     packetData += std::to_string(static_cast<int>(serverPacket::UPDATE));
+    packetData += std::to_string(getMicros()); //Send time, for one-way delay on the client
 
     for (auto& p : playerList){
+        packetData += ";";
         packetData += std::to_string(p.second.id);
         packetData += ";";
         packetData += std::to_string(p.second.x);
         packetData += ";";
         packetData += std::to_string(p.second.y);
-        packetData += ";";
     }
-    packetData.pop_back(); //Remove last semicolon
 
     //Send player positions to each player
     ENetPacket* packet = enet_packet_create(packetData.c_str(), packetData.length() + 1, 0);
 
     for (int i=0; i < server->peerCount; i++){
-        if (server->peers[i].address.host != 0)
+        if (server->peers[i].state == ENET_PEER_STATE_CONNECTED)
             enet_peer_send(&(server->peers[i]), 0, packet);
     }
 
     return 16; //ms
 }
 
-unsigned int analyzePackets(unsigned int a, void* b){
-    static int threshold_counter = 0;
-    threshold_counter++;
+void analyzePackets(Player& player){
+    int id = player.id;
 
     //Get Sample
-    for (auto& p : playerList){
-        packetCount[p.second.id].push_back(packet_counter[p.second.id]);
-        std::cout << "Sample for Player [" << p.second.id << "]: " << packet_counter[p.second.id] << std::endl;
-        packet_counter[p.second.id] = 0;
+    packetCount[id].push_back(packet_counter[id]);
+    player.lastSample = packet_counter[id];
+    //One-way delays in ms; error bound comes from the best round trip
+    ClockSync& clock = player.clock;
+    if (clock.hasInboundDelay() && clock.hasOutboundDelay()){
+        LOG_INFO("Sample for Player [{}]: {} | Up {}ms, Down {}ms (+/-{}ms)", id, packet_counter[id],
+                 clock.inboundDelay() / 1000.0, clock.outboundDelay() / 1000.0, clock.error() / 1000.0);
+    }
+    else if (clock.hasInboundDelay()){
+        LOG_INFO("Sample for Player [{}]: {} | Up {}ms, Down unknown (+/-{}ms)", id, packet_counter[id],
+                 clock.inboundDelay() / 1000.0, clock.error() / 1000.0);
+    }
+    else if (clock.hasOutboundDelay()){
+        LOG_INFO("Sample for Player [{}]: {} | Up unknown, Down {}ms (+/-{}ms)", id, packet_counter[id],
+                 clock.outboundDelay() / 1000.0, clock.error() / 1000.0);
     }
+    else{
+        LOG_INFO("Sample for Player [{}]: {} | Delays unknown", id, packet_counter[id]);
+    }
+    packet_counter[id] = 0;
 
-    if (threshold_counter == THRESHOLD){
+    if (packetCount[id].size() == THRESHOLD){
         //Perform analysis
 
         //Clear data
-        for (auto& p : playerList){
-            packetCount[p.second.id].clear();
-        }
+        packetCount[id].clear();
+    }
+}
+
+void sendScores(){
+    //Latest detector figures for every player, one packet shared by all spectators
+    std::string packetData;
+    packetData += std::to_string(static_cast<int>(serverPacket::SCORES));
+
+    for (auto& p : playerList){
+        packetData += std::to_string(p.second.id);
+        packetData += ";";
+        packetData += std::to_string(p.second.lastSample); //packets
+        packetData += ";";
+        ClockSync& clock = p.second.clock;
+        packetData += std::to_string(clock.hasInboundDelay() ? clock.inboundDelay() : -1); //up, us (-1 = unknown)
+        packetData += ";";
+        packetData += std::to_string(clock.hasOutboundDelay() ? clock.outboundDelay() : -1); //down, us
+        packetData += ";";
+        packetData += std::to_string(clock.synced() ? clock.error() : -1); //us
+        packetData += ";";
+    }
+    if (!playerList.empty())
+        packetData.pop_back(); //Remove last semicolon
+
+    ENetPacket* packet = enet_packet_create(packetData.c_str(), packetData.length() + 1, 0);
+    for (auto& s : spectators)
+        enet_peer_send(s, 0, packet);
+}
+
+void onTimer(TimerNode* timer){
+    Player* player;
+
+    switch (static_cast<timerEvent>(timer->kind)){
+        case timerEvent::TIMEOUT:
+            if ((player = findPlayer(timer->owner)) == nullptr)
+                break;
+            LOG_WARN("Player [{}] timed out.", player->id);
+            enet_peer_disconnect_now(player->peer, 0); //Raises no DISCONNECT event, so clean up here
+            disconnectPlayer(player->peer);
+            printPlayerCount();
+            break;
+        case timerEvent::SAMPLE:
+            if ((player = findPlayer(timer->owner)) == nullptr)
+                break;
+            analyzePackets(*player);
+            timers.schedule(timer, SAMPLE_RATE);
+            break;
+        case timerEvent::PING:
+            if ((player = findPlayer(timer->owner)) == nullptr)
+                break;
+            sendPing(player->peer, static_cast<int>(serverPacket::PING));
+            timers.schedule(timer, CLOCK_PING_RATE);
+            break;
+        case timerEvent::SCORES:
+            //Server-wide, not owned by a player
+            if (!spectators.empty())
+                sendScores();
+            timers.schedule(timer, SAMPLE_RATE);
+            break;
     }
+}
 
-    return 1000;
+Player* findPlayer(int id){
+    //Per-player timers are cancelled when the player is removed, so this should always succeed
+    auto iter = playerList.find(id);
+    return iter == playerList.end() ? nullptr : &iter->second;
 }
\ No newline at end of file